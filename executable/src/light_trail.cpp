@@ -1,12 +1,15 @@
+#include <memory>
 #include <string>
 #include <video_filter/CommandLineParser.hpp>
+#include <video_filter/FrameCache.hpp>
 #include <video_filter/LightTrail.hpp>
 
 int main(int argc, char** argv) {
   std::unordered_map<std::string, InputParser::Option> options = {
       {"-threshold", {"30", false, false}},
       {"-halo_radius", {"50", false, false}},
-      {"-use_region_growing", {"false", false, false}}};
+      {"-use_region_growing", {"false", false, false}},
+      {"-frame_cache", {"", false, false}}};
   std::vector<std::string> positionalArgs = {"input_video", "output_video"};
 
   InputParser input(argc, argv, options, positionalArgs);
@@ -16,9 +19,10 @@ int main(int argc, char** argv) {
   bool useRegionGrowing = input.getCmdOption<bool>("-use_region_growing");
   std::string inputFile = input.getCmdOption<std::string>("input_video");
   std::string outputFile = input.getCmdOption<std::string>("output_video");
+  std::string frameCacheDir = input.getCmdOption<std::string>("-frame_cache");
 
   LightTrail lightTrail(inputFile, outputFile, threshold, haloPixelSize, useRegionGrowing);
-  lightTrail.processVideo();
+  std::unique_ptr<FrameSource> source = openVideoSource(inputFile, frameCacheDir);
 
-  return 0;
+  return lightTrail.processVideo(*source) ? 0 : 1;
 }
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <video_filter/CommandLineParser.hpp>
+#include <video_filter/FrameCache.hpp>
+#include <video_filter/LightTrail.hpp>
+#include <video_filter/detail/WorkStealingPool.hpp>
+
+// One line of the manifest:
+// <input_video> <output_video> <roi_x> <roi_y> <roi_width> <roi_height>
+//   [-threshold N] [-halo_radius N] [-use_region_growing true|false]
+// Empty lines and lines starting with '#' are ignored.
+// Only the initial ROI is given; the light is tracked from there on, a
+// predefined trajectory is not supported.
+struct Job {
+  std::string inputFile;
+  std::string outputFile;
+  cv::Rect2d roi;
+  int threshold = 30;
+  int haloPixelSize = 50;
+  bool useRegionGrowing = false;
+};
+
+struct JobResult {
+  bool success = false;
+  size_t frames = 0;
+  double seconds = 0.;
+};
+
+bool parseJob(const std::string& line, Job* job, std::string* error) {
+  std::istringstream iss(line);
+  if (!(iss >> job->inputFile >> job->outputFile >> job->roi.x >> job->roi.y >>
+        job->roi.width >> job->roi.height)) {
+    *error = "expected <input> <output> <x> <y> <width> <height>";
+    return false;
+  }
+  if (job->roi.width <= 0 || job->roi.height <= 0) {
+    *error = "ROI width and height must be positive";
+    return false;
+  }
+  std::string key;
+  while (iss >> key) {
+    std::string value;
+    if (!(iss >> value)) {
+      *error = "missing value for option " + key;
+      return false;
+    }
+    if (key == "-threshold") {
+      job->threshold = std::stoi(value);
+    } else if (key == "-halo_radius") {
+      job->haloPixelSize = std::stoi(value);
+    } else if (key == "-use_region_growing") {
+      if (value == "true" || value == "1") {
+        job->useRegionGrowing = true;
+      } else if (value == "false" || value == "0") {
+        job->useRegionGrowing = false;
+      } else {
+        *error = "invalid value for option " + key + ": " + value;
+        return false;
+      }
+    } else {
+      *error = "invalid option " + key;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool readManifest(const std::string& manifestFile, std::vector<Job>* jobs) {
+  std::ifstream manifest(manifestFile);
+  if (!manifest.is_open()) {
+    std::cerr << "Could not open manifest " << manifestFile << std::endl;
+    return false;
+  }
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(manifest, line)) {
+    lineNumber++;
+    const size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+    Job job;
+    std::string error;
+    try {
+      if (!parseJob(line, &job, &error)) {
+        std::cerr << manifestFile << ":" << lineNumber << ": " << error << std::endl;
+        return false;
+      }
+    } catch (const std::exception& e) {
+      std::cerr << manifestFile << ":" << lineNumber << ": " << e.what() << std::endl;
+      return false;
+    }
+    jobs->push_back(job);
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::unordered_map<std::string, InputParser::Option> options = {
+      {"-workers", {std::to_string(std::max(1u, hardwareThreads / 2)), false, false}},
+      {"-threads", {std::to_string(hardwareThreads), false, false}},
+      {"-frame_cache", {"", false, false}}};
+  std::vector<std::string> positionalArgs = {"manifest"};
+
+  InputParser input(argc, argv, options, positionalArgs);
+
+  const int workers = std::max(1, input.getCmdOption<int>("-workers"));
+  const int threads = std::max(1, input.getCmdOption<int>("-threads"));
+  const std::string manifestFile = input.getCmdOption<std::string>("manifest");
+  const std::string frameCacheDir = input.getCmdOption<std::string>("-frame_cache");
+
+  std::vector<Job> jobs;
+  if (!readManifest(manifestFile, &jobs)) {
+    return 1;
+  }
+  if (jobs.empty()) {
+    std::cerr << "Manifest " << manifestFile << " contains no jobs" << std::endl;
+    return 1;
+  }
+
+  // cv::setNumThreads is process wide and limits how many threads a single
+  // parallel OpenCV call fans out to. Split the thread budget between the
+  // concurrently running jobs so they do not oversubscribe the machine.
+  const int numWorkers = std::min<int>(workers, jobs.size());
+  const int threadsPerJob = std::max(1, threads / numWorkers);
+  cv::setNumThreads(threadsPerJob);
+
+  std::vector<JobResult> results(jobs.size());
+  std::mutex outputMutex;
+  size_t finishedJobs = 0;
+  const auto batchStart = std::chrono::steady_clock::now();
+  {
+    WorkStealingPool pool(numWorkers);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+      pool.submit([&, i] {
+        const Job& job = jobs[i];
+        JobResult& result = results[i];
+        const auto start = std::chrono::steady_clock::now();
+
+        LightTrail lightTrail(job.inputFile,
+                              job.outputFile,
+                              job.threshold,
+                              job.haloPixelSize,
+                              job.useRegionGrowing);
+        lightTrail.setInitialRoi(job.roi);
+        lightTrail.setInteractive(false);
+        try {
+          std::unique_ptr<FrameSource> source =
+              openVideoSource(job.inputFile, frameCacheDir);
+          result.success = lightTrail.processVideo(*source);
+        } catch (const std::exception& e) {
+          std::lock_guard<std::mutex> lock(outputMutex);
+          std::cerr << job.inputFile << ": " << e.what() << std::endl;
+        }
+        result.frames = lightTrail.getProcessedFrames();
+        result.seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                .count();
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+        finishedJobs++;
+        std::cout << "[" << finishedJobs << "/" << jobs.size() << "] "
+                  << (result.success ? "done   " : "FAILED ") << job.inputFile
+                  << " -> " << job.outputFile << ": " << result.frames
+                  << " frames in " << result.seconds << " s ("
+                  << (result.seconds > 0. ? result.frames / result.seconds : 0.)
+                  << " fps)" << std::endl;
+      });
+    }
+    pool.wait();
+  }
+  const double batchSeconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart)
+          .count();
+
+  size_t failed = 0;
+  size_t totalFrames = 0;
+  for (const JobResult& result : results) {
+    failed += result.success ? 0 : 1;
+    totalFrames += result.frames;
+  }
+
+  std::cout << "\nSummary: " << jobs.size() - failed << "/" << jobs.size()
+            << " jobs succeeded, " << totalFrames << " frames in " << batchSeconds
+            << " s (" << (batchSeconds > 0. ? totalFrames / batchSeconds : 0.)
+            << " fps) using " << numWorkers << " workers, thread budget " << threads
+            << " (" << threadsPerJob << " OpenCV threads per job)" << std::endl;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    if (!results[i].success) {
+      std::cout << "  failed: " << jobs[i].inputFile << std::endl;
+    }
+  }
+
+  return failed == 0 ? 0 : 1;
+}
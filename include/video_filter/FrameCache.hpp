@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <video_filter/FrameIO.hpp>
+#include <video_filter/VideoFileIO.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#endif
+
+// On disk cache of decoded frames. One cache file per video, named after the
+// hash of the video content, holds a header followed by the raw frames back
+// to back. The file is memory mapped read only so reading a frame is a
+// single copy out of the page cache instead of a decode.
+// Opt-in: include this header only where a cached source is built, it pulls
+// in POSIX headers.
+class FrameCache {
+ public:
+  FrameCache() = default;
+  FrameCache(const FrameCache&) = delete;
+  FrameCache& operator=(const FrameCache&) = delete;
+
+  ~FrameCache() { close(); }
+
+  static bool isSupported() {
+#ifdef _WIN32
+    return false;
+#else
+    return true;
+#endif
+  }
+
+  // FNV-1a over the whole file. Reading the file is much cheaper than
+  // decoding it.
+  static std::string hashFile(const std::string& file) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open()) {
+      return "";
+    }
+    uint64_t hash = 14695981039346656037ull;
+    std::vector<char> buffer(1 << 20);
+    while (in) {
+      in.read(buffer.data(), buffer.size());
+      const std::streamsize bytesRead = in.gcount();
+      for (std::streamsize i = 0; i < bytesRead; ++i) {
+        hash ^= static_cast<unsigned char>(buffer[i]);
+        hash *= 1099511628211ull;
+      }
+    }
+    std::ostringstream oss;
+    oss << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return oss.str();
+  }
+
+  static std::string cacheFileFor(const std::string& videoFile,
+                                  const std::string& cacheDir) {
+    const std::string hash = hashFile(videoFile);
+    if (hash.empty()) {
+      return "";
+    }
+    return cacheDir + "/" + hash + ".frames";
+  }
+
+  // Makes sure cacheFile exists, decoding the video into it if needed. Only
+  // one builder per cache file runs at a time (across threads and processes,
+  // via flock on <cacheFile>.lock); the others wait and then use its result.
+  // A build that failed is not retried by the same process.
+  static bool buildOnce(const std::string& videoFile, const std::string& cacheFile) {
+#ifdef _WIN32
+    return false;
+#else
+    static std::mutex failedMutex;
+    static std::set<std::string> failedBuilds;
+    {
+      std::lock_guard<std::mutex> lock(failedMutex);
+      if (failedBuilds.count(cacheFile) > 0) {
+        return false;
+      }
+    }
+
+    const std::string lockFile = cacheFile + ".lock";
+    const int lockFd = ::open(lockFile.c_str(), O_CREAT | O_RDWR, 0644);
+    if (lockFd < 0 || flock(lockFd, LOCK_EX) != 0) {
+      if (lockFd >= 0) {
+        ::close(lockFd);
+      }
+      std::cerr << "Could not lock frame cache " << lockFile << std::endl;
+      return false;
+    }
+
+    bool success;
+    {
+      std::lock_guard<std::mutex> lock(failedMutex);
+      success = failedBuilds.count(cacheFile) == 0;
+    }
+    if (success && !FrameCache().open(cacheFile)) {
+      std::cout << "Building frame cache " << cacheFile << std::endl;
+      success = build(videoFile, cacheFile);
+      if (!success) {
+        std::lock_guard<std::mutex> lock(failedMutex);
+        failedBuilds.insert(cacheFile);
+      }
+    }
+
+    flock(lockFd, LOCK_UN);
+    ::close(lockFd);
+    return success;
+#endif
+  }
+
+  bool open(const std::string& cacheFile) {
+    close();
+#ifdef _WIN32
+    return false;
+#else
+    const int fd = ::open(cacheFile.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 ||
+        static_cast<uint64_t>(fileStat.st_size) < kDataOffset) {
+      ::close(fd);
+      return false;
+    }
+    void* data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+      return false;
+    }
+    mapping = static_cast<const unsigned char*>(data);
+    mappingSize = fileStat.st_size;
+
+    std::memcpy(&header, mapping, sizeof(header));
+    if (!isHeaderValid()) {
+      std::cerr << "Invalid frame cache " << cacheFile << std::endl;
+      close();
+      return false;
+    }
+    madvise(data, mappingSize, MADV_SEQUENTIAL);
+    return true;
+#endif
+  }
+
+  void close() {
+#ifndef _WIN32
+    if (mapping != nullptr) {
+      munmap(const_cast<unsigned char*>(mapping), mappingSize);
+    }
+#endif
+    mapping = nullptr;
+    mappingSize = 0;
+    header = Header();
+  }
+
+  bool isOpened() const { return mapping != nullptr; }
+
+  // Copies the frame into the buffer, reusing it if size and type match.
+  bool copyFrame(int index, cv::Mat& frame) const {
+    if (!isOpened() || index < 0 || static_cast<uint64_t>(index) >= header.frameCount) {
+      return false;
+    }
+    // The mapping is read only: the view must never be handed out.
+    const cv::Mat view(header.height,
+                       header.width,
+                       header.type,
+                       const_cast<unsigned char*>(frameData(index)));
+    view.copyTo(frame);
+    return true;
+  }
+
+  // Drops the pages of a frame that will not be read again from the mapping,
+  // so a long clip does not stay resident.
+  void releaseFrame(int index) const {
+#ifndef _WIN32
+    if (!isOpened() || index < 0 || static_cast<uint64_t>(index) >= header.frameCount) {
+      return;
+    }
+    const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(frameData(index));
+    const uintptr_t end = begin + header.frameBytes;
+    const uintptr_t alignedBegin = begin / pageSize * pageSize;
+    const uintptr_t alignedEnd = end / pageSize * pageSize;
+    if (alignedEnd > alignedBegin) {
+      madvise(reinterpret_cast<void*>(alignedBegin),
+              alignedEnd - alignedBegin,
+              MADV_DONTNEED);
+    }
+#endif
+  }
+
+  int getFrameCount() const { return static_cast<int>(header.frameCount); }
+
+  cv::Size getFrameSize() const { return cv::Size(header.width, header.height); }
+
+  double getFps() const { return header.fps; }
+
+ private:
+  static constexpr std::array<char, 8> kMagic = {'V', 'F', 'C', 'A', 'C', 'H', 'E', '\0'};
+  static constexpr uint32_t kVersion = 1;
+  // Frames start page aligned.
+  static constexpr uint64_t kDataOffset = 4096;
+
+  struct Header {
+    std::array<char, 8> magic = kMagic;
+    uint32_t version = kVersion;
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t type = 0;
+    double fps = 0.;
+    uint64_t frameCount = 0;
+    uint64_t frameBytes = 0;
+  };
+
+  Header header;
+  const unsigned char* mapping = nullptr;
+  uint64_t mappingSize = 0;
+
+  // Every field is used to build cv::Mat views into the mapping, so a corrupt
+  // header must never get past this check.
+  bool isHeaderValid() const {
+    if (header.magic != kMagic || header.version != kVersion || header.width <= 0 ||
+        header.height <= 0 || header.type != CV_MAT_TYPE(header.type) ||
+        CV_MAT_DEPTH(header.type) > CV_64F) {
+      return false;
+    }
+    const uint64_t expectedFrameBytes = static_cast<uint64_t>(header.width) *
+                                        static_cast<uint64_t>(header.height) *
+                                        CV_ELEM_SIZE(header.type);
+    if (header.frameBytes != expectedFrameBytes || mappingSize < kDataOffset) {
+      return false;
+    }
+    // Division instead of frameBytes * frameCount, which could overflow.
+    const uint64_t maxFrames = (mappingSize - kDataOffset) / header.frameBytes;
+    return header.frameCount <= maxFrames &&
+           header.frameCount <= static_cast<uint64_t>(std::numeric_limits<int>::max());
+  }
+
+  const unsigned char* frameData(int index) const {
+    return mapping + kDataOffset + header.frameBytes * index;
+  }
+
+  // Decodes the whole video into cacheFile. Must be called with the build
+  // lock held. The cache is written to a temporary file and renamed, so
+  // readers never see a half written cache.
+  static bool build(const std::string& videoFile, const std::string& cacheFile) {
+#ifdef _WIN32
+    return false;
+#else
+    VideoFileSource source(videoFile);
+    if (!source.isOpened()) {
+      return false;
+    }
+
+    // Raw frames are big: refuse to start if the cache can not fit. The
+    // estimate assumes decoded BGR24 frames.
+    const size_t dirEnd = cacheFile.find_last_of('/');
+    const std::string cacheDir =
+        dirEnd == std::string::npos ? "." : cacheFile.substr(0, dirEnd + 1);
+    const cv::Size size = source.getFrameSize();
+    const uint64_t expectedBytes = kDataOffset + static_cast<uint64_t>(size.area()) * 3 *
+                                                     std::max(0, source.getFrameCount());
+    struct statvfs fsStat;
+    if (statvfs(cacheDir.c_str(), &fsStat) == 0 &&
+        static_cast<uint64_t>(fsStat.f_bavail) * fsStat.f_frsize < expectedBytes) {
+      std::cerr << "Not enough free space in " << cacheDir << " for the frame cache ("
+                << expectedBytes / (1024 * 1024) << " MB needed)" << std::endl;
+      return false;
+    }
+
+    // Written under the build lock, so an existing tmp file is the leftover
+    // of a killed build and simply overwritten.
+    const std::string tmpFile = cacheFile + ".tmp";
+    std::FILE* out = std::fopen(tmpFile.c_str(), "wb");
+    if (out == nullptr) {
+      std::cerr << "Could not create frame cache " << tmpFile << std::endl;
+      return false;
+    }
+
+    Header header;
+    header.fps = source.getFps();
+    bool success = std::fseek(out, kDataOffset, SEEK_SET) == 0;
+    cv::Mat frame;
+    while (success && source.read(frame)) {
+      if (header.frameCount == 0) {
+        header.width = frame.cols;
+        header.height = frame.rows;
+        header.type = frame.type();
+        header.frameBytes = frame.total() * frame.elemSize();
+      } else if (frame.cols != header.width || frame.rows != header.height ||
+                 frame.type() != header.type) {
+        std::cerr << "Frame format changed while building frame cache" << std::endl;
+        success = false;
+        break;
+      }
+      if (!frame.isContinuous()) {
+        frame = frame.clone();
+      }
+      success = std::fwrite(frame.data, 1, header.frameBytes, out) == header.frameBytes;
+      header.frameCount++;
+    }
+
+    success = success && header.frameCount > 0 && std::fseek(out, 0, SEEK_SET) == 0 &&
+              std::fwrite(&header, sizeof(header), 1, out) == 1;
+    success = std::fclose(out) == 0 && success;
+    if (!success || std::rename(tmpFile.c_str(), cacheFile.c_str()) != 0) {
+      std::cerr << "Could not write frame cache " << cacheFile << std::endl;
+      std::remove(tmpFile.c_str());
+      return false;
+    }
+    return true;
+#endif
+  }
+};
+
+// Reads the frames of a video from the frame cache in cacheDir. The cache is
+// built on first use; later runs on the same video skip decoding entirely.
+class CachedVideoSource : public FrameSource {
+  FrameCache cache;
+  int nextFrame = 0;
+
+ public:
+  CachedVideoSource(const std::string& videoFile, const std::string& cacheDir) {
+    if (!FrameCache::isSupported()) {
+      return;
+    }
+#ifndef _WIN32
+    mkdir(cacheDir.c_str(), 0755);
+#endif
+    const std::string cacheFile = FrameCache::cacheFileFor(videoFile, cacheDir);
+    if (cacheFile.empty()) {
+      return;
+    }
+    if (!cache.open(cacheFile) && FrameCache::buildOnce(videoFile, cacheFile)) {
+      cache.open(cacheFile);
+    }
+  }
+
+  bool isOpened() const override { return cache.isOpened(); }
+
+  bool read(cv::Mat& frame) override {
+    if (!cache.copyFrame(nextFrame, frame)) {
+      return false;
+    }
+    cache.releaseFrame(nextFrame);
+    nextFrame++;
+    return true;
+  }
+
+  cv::Size getFrameSize() const override { return cache.getFrameSize(); }
+
+  double getFps() const override { return cache.getFps(); }
+
+  int getFrameCount() const override { return cache.getFrameCount(); }
+};
+
+// Opens the video through the frame cache in cacheDir. The cache is only an
+// optimization: if it can not be used the video is decoded as usual.
+inline std::unique_ptr<FrameSource> openVideoSource(const std::string& videoFile,
+                                                    const std::string& cacheDir) {
+  if (!cacheDir.empty()) {
+    auto cached = std::make_unique<CachedVideoSource>(videoFile, cacheDir);
+    if (cached->isOpened()) {
+      return cached;
+    }
+    std::cerr << "Warning: frame cache in " << cacheDir
+              << " not usable, decoding " << videoFile << " directly" << std::endl;
+  }
+  return std::make_unique<VideoFileSource>(videoFile);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+// Pull side of a pipeline. read() may hand out a view into memory owned by
+// the source (like cv::VideoCapture does); it stays valid until the next
+// call to read().
+class FrameSource {
+ public:
+  virtual ~FrameSource() = default;
+
+  virtual bool isOpened() const = 0;
+
+  virtual bool read(cv::Mat& frame) = 0;
+
+  virtual cv::Size getFrameSize() const = 0;
+
+  virtual double getFps() const = 0;
+
+  // Returns -1 if the number of frames is not known in advance.
+  virtual int getFrameCount() const { return -1; }
+};
+
+// Push side of a pipeline.
+class FrameSink {
+ public:
+  virtual ~FrameSink() = default;
+
+  virtual bool isOpened() const = 0;
+
+  virtual bool write(const cv::Mat& frame) = 0;
+};
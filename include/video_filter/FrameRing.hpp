@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <video_filter/FrameIO.hpp>
+
+// Bounded single producer / single consumer queue of preallocated frames.
+// The producer fills a slot in place (acquireWrite, commitWrite), the
+// consumer works on the slot in place (acquireRead, releaseRead), so frames
+// are never copied by the ring itself.
+class FrameRing {
+ public:
+  FrameRing(size_t capacity, const cv::Size& frameSize, double fps, int type = CV_8UC3)
+      : frameSize(frameSize), fps(fps) {
+    slots.resize(std::max<size_t>(1, capacity));
+    for (auto& slot : slots) {
+      slot.create(frameSize, type);
+    }
+  }
+
+  FrameRing(const FrameRing&) = delete;
+  FrameRing& operator=(const FrameRing&) = delete;
+
+  // Blocks while the ring is full. Returns nullptr once the ring is closed.
+  cv::Mat* acquireWrite() {
+    std::unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [this] { return closed || count < slots.size(); });
+    if (closed) {
+      return nullptr;
+    }
+    return &slots[(head + count) % slots.size()];
+  }
+
+  void commitWrite() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++count;
+    }
+    notEmpty.notify_one();
+  }
+
+  // Blocks while the ring is empty. Returns nullptr once the ring is closed
+  // and drained.
+  cv::Mat* acquireRead() {
+    std::unique_lock<std::mutex> lock(mutex);
+    notEmpty.wait(lock, [this] { return closed || count > 0; });
+    if (count == 0) {
+      return nullptr;
+    }
+    return &slots[head];
+  }
+
+  void releaseRead() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      head = (head + 1) % slots.size();
+      --count;
+    }
+    notFull.notify_one();
+  }
+
+  // Ends the stream: pending frames can still be read, no new frames are
+  // accepted.
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      closed = true;
+    }
+    notFull.notify_all();
+    notEmpty.notify_all();
+  }
+
+  size_t capacity() const { return slots.size(); }
+
+  cv::Size getFrameSize() const { return frameSize; }
+
+  double getFps() const { return fps; }
+
+ private:
+  std::vector<cv::Mat> slots;
+  cv::Size frameSize;
+  double fps;
+  std::mutex mutex;
+  std::condition_variable notFull;
+  std::condition_variable notEmpty;
+  size_t head = 0;
+  size_t count = 0;
+  bool closed = false;
+};
+
+// Hands out views of the ring slots. A slot is returned to the producer on
+// the next read().
+class FrameRingSource : public FrameSource {
+  FrameRing& ring;
+  bool holdsSlot = false;
+
+ public:
+  explicit FrameRingSource(FrameRing& ring) : ring(ring) {}
+
+  ~FrameRingSource() override {
+    if (holdsSlot) {
+      ring.releaseRead();
+    }
+  }
+
+  bool isOpened() const override { return true; }
+
+  bool read(cv::Mat& frame) override {
+    if (holdsSlot) {
+      ring.releaseRead();
+      holdsSlot = false;
+    }
+    cv::Mat* slot = ring.acquireRead();
+    if (slot == nullptr) {
+      return false;
+    }
+    frame = *slot;
+    holdsSlot = true;
+    return true;
+  }
+
+  cv::Size getFrameSize() const override { return ring.getFrameSize(); }
+
+  double getFps() const override { return ring.getFps(); }
+};
+
+// Copies written frames into the preallocated ring slots. Closes the ring
+// when destroyed so the consumer sees the end of the stream.
+class FrameRingSink : public FrameSink {
+  FrameRing& ring;
+
+ public:
+  explicit FrameRingSink(FrameRing& ring) : ring(ring) {}
+
+  ~FrameRingSink() override { ring.close(); }
+
+  bool isOpened() const override { return true; }
+
+  bool write(const cv::Mat& frame) override {
+    cv::Mat* slot = ring.acquireWrite();
+    if (slot == nullptr) {
+      return false;
+    }
+    frame.copyTo(*slot);
+    ring.commitWrite();
+    return true;
+  }
+};
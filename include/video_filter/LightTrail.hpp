@@ -6,11 +6,12 @@
 #include <queue>
 #include <string>
 #include <video_filter/CommandLineParser.hpp>
+#include <video_filter/FrameIO.hpp>
+#include <video_filter/LightTrailFilter.hpp>
 #include <video_filter/RoiSelect.hpp>
+#include <video_filter/VideoFileIO.hpp>
 #include <video_filter/detail/ProgressBar.hpp>
-#include <video_filter/detail/stringUtils.hpp>
 #include <video_filter/frame.hpp>
-#include <video_filter/tracker.hpp>
 
 class LightTrail {
  public:
@@ -25,88 +26,105 @@ class LightTrail {
         haloPixelSize(haloPixelSize),
         useRegionGrowing(useRegionGrowing) {}
 
-  void processVideo() {
-    cv::VideoCapture cap(inputFile);
-    if (!cap.isOpened()) {
+  // Skips the interactive ROI selection and starts tracking the given ROI
+  // on the first frame.
+  void setInitialRoi(const cv::Rect2d& roi) {
+    initialRoi = roi;
+    initialRoiSet = true;
+  }
+
+  // Without interaction no windows are opened and no progress bar is printed.
+  // Required when processVideo runs on a worker thread.
+  // Requires an initial ROI.
+  void setInteractive(bool interactive) { this->interactive = interactive; }
+
+  size_t getProcessedFrames() const { return processedFrames; }
+
+  bool processVideo() {
+    VideoFileSource source(inputFile);
+    return processVideo(source);
+  }
+
+  // Reads from the given source (e.g. a CachedVideoSource) and writes the
+  // output video file.
+  bool processVideo(FrameSource& source) {
+    if (!source.isOpened()) {
       std::cerr << "Error opening video stream or file" << std::endl;
-      return;
+      return false;
     }
 
-    int codec = getCodec();
-    if (codec == -1) {
-      std::cerr << "Unsupported output video format" << std::endl;
-      return;
+    VideoFileSink sink(outputFile, source.getFps(), source.getFrameSize());
+    if (!sink.isOpened()) {
+      std::cerr << "Could not open the output video file for write" << std::endl;
+      return false;
     }
 
-    int frameWidth = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
-    int frameHeight = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
-    int fps = static_cast<int>(cap.get(cv::CAP_PROP_FPS));
-    int totalFrames = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_COUNT));
+    return processVideo(source, sink);
+  }
 
-    cv::VideoWriter writer(outputFile, codec, fps, cv::Size(frameWidth, frameHeight));
-    if (!writer.isOpened()) {
-      std::cerr << "Could not open the output video file for write" << std::endl;
-      return;
+  bool processVideo(FrameSource& source, FrameSink& sink) {
+    processedFrames = 0;
+    if (!interactive && !initialRoiSet) {
+      std::cerr << "Non interactive processing requires an initial ROI" << std::endl;
+      return false;
     }
 
-    cv::Mat lightTrail = cv::Mat::zeros(frameHeight, frameWidth, CV_8UC3);
-    int gaussKernalSize = haloPixelSize % 2 == 1 ? haloPixelSize : haloPixelSize + 1;
-    cv::Point2d prevLight(-1., -1.);
-    bool prevLightSet = false;
-
-    ProgressBar progress_bar(totalFrames);
+    LightTrailFilter filter;
+    const bool showProgress = interactive && source.getFrameCount() > 0;
+    ProgressBar progress_bar(std::max(0, source.getFrameCount()));
     int frameCount = 0;
-    double roiRadius = 0;
-    std::unique_ptr<Tracker> tracker = nullptr;
 
-    cv::namedWindow("LightTrail", cv::WINDOW_AUTOSIZE);
-    cv::setMouseCallback("LightTrail", onMouse, this);
+    if (interactive) {
+      stopTrail = false;
+      cv::namedWindow("LightTrail", cv::WINDOW_AUTOSIZE);
+      cv::setMouseCallback("LightTrail", onMouse, this);
+    }
 
-    while (cap.read(frame)) {
+    // Local on purpose: the source may hand out views into memory it owns.
+    cv::Mat frame;
+    bool success = true;
+    while (source.read(frame)) {
       Frame f{frame, std::chrono::nanoseconds(frameCount)};
-      if (tracker == nullptr) {
-        RoiSelect roiSelector(frame);
-        cv::Rect2d roi;
-        if (roiSelector.selectRoi(&roi)) {
-          tracker = std::make_unique<Tracker>(f, roi);
-          roiRadius = std::max(roi.width, roi.height);
+      if (!filter.isInitialized()) {
+        cv::Rect2d roi = initialRoi;
+        if (initialRoiSet || RoiSelect(frame).selectRoi(&roi)) {
+          filter.initialize(f, roi);
         }
         frameCount++;
         continue;
       }
 
-      if (!tracker->track(f)) {
+      if (stopTrail) {
+        filter.stopTrail();
+      }
+      filter.process(f);
+      if (!filter.isTracking()) {
+        success = false;
         break;
       }
 
-      const cv::Point2d lightPos = tracker->getLastTrack().second;
-      const cv::Rect roi = getROI(frame.size(), lightPos, roiRadius);
-      cv::Mat light = frame(roi).clone();
-
-      cv::Point2f translation(0.0);
-      if (prevLightSet) {
-        translation = prevLight - lightPos;
+      if (interactive) {
+        debugDisplay(f.getImage(), filter.getTracker()->getLastTrack().second);
       }
-      prevLightSet = true;
-      prevLight = lightPos;
 
-      if (!stopTrail) {
-        applyTranslationIncrementally(light, roi, translation, lightTrail);
+      if (!sink.write(f.getImage())) {
+        std::cerr << "Could not write frame " << frameCount << std::endl;
+        success = false;
+        break;
       }
 
-      frame = cv::max(frame, lightTrail);
-      debugDisplay(frame, lightPos);
-
-      writer.write(frame);
-
       frameCount++;
-      ++progress_bar;
-      progress_bar.display();
+      processedFrames++;
+      if (showProgress) {
+        ++progress_bar;
+        progress_bar.display();
+      }
     }
 
-    cap.release();
-    writer.release();
-    cv::destroyAllWindows();
+    if (interactive) {
+      cv::destroyAllWindows();
+    }
+    return success;
   }
 
  private:
@@ -115,8 +133,11 @@ class LightTrail {
   int threshold;
   int haloPixelSize;
   bool useRegionGrowing;
-  cv::Mat frame;
   bool stopTrail = false;
+  bool interactive = true;
+  cv::Rect2d initialRoi;
+  bool initialRoiSet = false;
+  size_t processedFrames = 0;
 
   static void onMouse(int event, int x, int y, int flags, void* userdata) {
     LightTrail* self = reinterpret_cast<LightTrail*>(userdata);
@@ -129,29 +150,6 @@ class LightTrail {
     }
   }
 
-  int getCodec() {
-    std::string fileExtension = getExtension(outputFile);
-    if (fileExtension == "mp4" || fileExtension == "MP4") {
-      return cv::VideoWriter::fourcc('m', 'p', '4', 'v');
-    } else if (fileExtension == "avi") {
-      return cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
-    } else if (fileExtension == "mov" || fileExtension == "MOV") {
-      return cv::VideoWriter::fourcc('m', 'p', '4', 'v');
-    } else {
-      return -1;
-    }
-  }
-
-  cv::Rect getROI(const cv::Size& frameSize, cv::Point2d center, double radius) {
-    cv::Point2d topLeft(std::max(0., center.x - radius), std::max(0., center.y - radius));
-    double size = radius * 2.;
-    cv::Point2d bottomRight(
-        std::min(topLeft.x + size, static_cast<double>(frameSize.width)),
-        std::min(topLeft.y + size, static_cast<double>(frameSize.height)));
-    return cv::Rect(
-        topLeft.x, topLeft.y, bottomRight.x - topLeft.x, bottomRight.y - topLeft.y);
-  }
-
   void debugDisplay(const cv::Mat& frame, const cv::Point2d& lightPos) {
     cv::Mat debug = frame.clone();
     cv::circle(debug, lightPos, 30, cv::Scalar(0, 255, 0), 2);
@@ -161,37 +159,4 @@ class LightTrail {
     cv::imshow("LightTrail", debug);
     cv::waitKey(1);
   }
-
-  void applyTranslationIncrementally(const cv::Mat& light,
-                                     const cv::Rect& roi,
-                                     const cv::Point2f& translation,
-                                     cv::Mat& lightTrail) {
-    int steps = std::ceil(
-        std::sqrt(translation.x * translation.x + translation.y * translation.y));
-    for (int i = 1; i <= steps; ++i) {
-      cv::Mat translatedLight = cv::Mat::zeros(light.size(), light.type());
-      float alpha = static_cast<double>(i) / steps;
-
-      cv::warpAffine(
-          light, translatedLight, getAffine(translation * alpha, 0), light.size());
-      cv::Rect roiTransformed = roi & cv::Rect(0, 0, lightTrail.cols, lightTrail.rows);
-      if (roiTransformed.area() <= 0) {
-        std::cerr << "Invalid transformed ROI, skipping frame" << std::endl;
-        continue;
-      }
-      lightTrail(roi) = cv::max(lightTrail(roi), translatedLight);
-    }
-    if (steps == 0) {
-      lightTrail(roi) = cv::max(lightTrail(roi), light);
-    }
-  }
-
-  cv::Mat getAffine(const cv::Point2f& translation, float angle) {
-    return (cv::Mat_<float>(2, 3) << std::cos(angle),
-            -std::sin(angle),
-            translation.x,
-            std::sin(angle),
-            std::cos(angle),
-            translation.y);
-  }
 };
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <video_filter/frame.hpp>
+#include <video_filter/tracker.hpp>
+
+// Push style light trail filter working on caller owned buffers. Every frame
+// handed to process() is modified in place; the filter only keeps the
+// accumulated trail and the tracker state (with its own copy of the
+// reference ROI) between frames, never a reference to the caller's buffer.
+class LightTrailFilter {
+ public:
+  LightTrailFilter() = default;
+
+  // Starts tracking the light inside roi. The frame itself is not filtered.
+  void initialize(const Frame& frame, const cv::Rect2d& roi) {
+    tracker = std::make_unique<Tracker>(frame, roi);
+    roiRadius = std::max(roi.width, roi.height);
+    lightTrail = cv::Mat::zeros(frame.getImage().size(), CV_8UC3);
+    prevLightSet = false;
+    trackingLost = false;
+  }
+
+  bool isInitialized() const { return tracker != nullptr; }
+
+  // False once the tracker lost the light. Frames are passed through
+  // unchanged from then on.
+  bool isTracking() const { return isInitialized() && !trackingLost; }
+
+  // Frames processed afterwards still show the trail but do not extend it.
+  void stopTrail() { trailStopped = true; }
+
+  const Tracker* getTracker() const { return tracker.get(); }
+
+  Frame& process(Frame& frame) {
+    if (!isTracking()) {
+      return frame;
+    }
+    if (!tracker->track(frame)) {
+      trackingLost = true;
+      return frame;
+    }
+
+    cv::Mat& image = frame.getImage();
+    const cv::Point2d lightPos = tracker->getLastTrack().second;
+    const cv::Rect roi = getROI(image.size(), lightPos, roiRadius);
+    // The view is only read before the trail is merged into the image below.
+    const cv::Mat light = image(roi);
+
+    cv::Point2f translation(0.0);
+    if (prevLightSet) {
+      translation = prevLight - lightPos;
+    }
+    prevLightSet = true;
+    prevLight = lightPos;
+
+    if (!trailStopped) {
+      applyTranslationIncrementally(light, roi, translation, lightTrail);
+    }
+
+    cv::max(image, lightTrail, image);
+    return frame;
+  }
+
+ private:
+  std::unique_ptr<Tracker> tracker = nullptr;
+  cv::Mat lightTrail;
+  double roiRadius = 0;
+  cv::Point2d prevLight{-1., -1.};
+  bool prevLightSet = false;
+  bool trackingLost = false;
+  bool trailStopped = false;
+
+  cv::Rect getROI(const cv::Size& frameSize, cv::Point2d center, double radius) {
+    cv::Point2d topLeft(std::max(0., center.x - radius), std::max(0., center.y - radius));
+    double size = radius * 2.;
+    cv::Point2d bottomRight(
+        std::min(topLeft.x + size, static_cast<double>(frameSize.width)),
+        std::min(topLeft.y + size, static_cast<double>(frameSize.height)));
+    return cv::Rect(
+        topLeft.x, topLeft.y, bottomRight.x - topLeft.x, bottomRight.y - topLeft.y);
+  }
+
+  void applyTranslationIncrementally(const cv::Mat& light,
+                                     const cv::Rect& roi,
+                                     const cv::Point2f& translation,
+                                     cv::Mat& lightTrail) {
+    int steps = std::ceil(
+        std::sqrt(translation.x * translation.x + translation.y * translation.y));
+    for (int i = 1; i <= steps; ++i) {
+      cv::Mat translatedLight = cv::Mat::zeros(light.size(), light.type());
+      float alpha = static_cast<double>(i) / steps;
+
+      cv::warpAffine(
+          light, translatedLight, getAffine(translation * alpha, 0), light.size());
+      cv::Rect roiTransformed = roi & cv::Rect(0, 0, lightTrail.cols, lightTrail.rows);
+      if (roiTransformed.area() <= 0) {
+        std::cerr << "Invalid transformed ROI, skipping frame" << std::endl;
+        continue;
+      }
+      lightTrail(roi) = cv::max(lightTrail(roi), translatedLight);
+    }
+    if (steps == 0) {
+      lightTrail(roi) = cv::max(lightTrail(roi), light);
+    }
+  }
+
+  cv::Mat getAffine(const cv::Point2f& translation, float angle) {
+    return (cv::Mat_<float>(2, 3) << std::cos(angle),
+            -std::sin(angle),
+            translation.x,
+            std::sin(angle),
+            std::cos(angle),
+            translation.y);
+  }
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdio>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <video_filter/FrameIO.hpp>
+
+// Reads packed BGR24 frames of a fixed size from a stream, e.g. the stdout of
+// `ffmpeg -f rawvideo -pix_fmt bgr24 -`. Frames are read straight into the
+// buffer handed to read().
+class RawPipeSource : public FrameSource {
+  std::FILE* stream;
+  bool ownsStream;
+  cv::Size frameSize;
+  double fps;
+
+ public:
+  // Does not take ownership of the stream (e.g. stdin).
+  RawPipeSource(std::FILE* stream, const cv::Size& frameSize, double fps)
+      : stream(stream), ownsStream(false), frameSize(frameSize), fps(fps) {}
+
+  // Opens a file or named pipe.
+  RawPipeSource(const std::string& path, const cv::Size& frameSize, double fps)
+      : stream(std::fopen(path.c_str(), "rb")),
+        ownsStream(true),
+        frameSize(frameSize),
+        fps(fps) {}
+
+  RawPipeSource(const RawPipeSource&) = delete;
+  RawPipeSource& operator=(const RawPipeSource&) = delete;
+
+  ~RawPipeSource() override {
+    if (ownsStream && stream != nullptr) {
+      std::fclose(stream);
+    }
+  }
+
+  bool isOpened() const override { return stream != nullptr; }
+
+  bool read(cv::Mat& frame) override {
+    if (stream == nullptr) {
+      return false;
+    }
+    frame.create(frameSize, CV_8UC3);
+    if (frame.isContinuous()) {
+      const size_t bytes = frame.total() * frame.elemSize();
+      return std::fread(frame.data, 1, bytes, stream) == bytes;
+    }
+    // A caller owned ROI view is not continuous: fill it row by row.
+    const size_t rowBytes = frame.cols * frame.elemSize();
+    for (int y = 0; y < frame.rows; ++y) {
+      if (std::fread(frame.ptr(y), 1, rowBytes, stream) != rowBytes) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  cv::Size getFrameSize() const override { return frameSize; }
+
+  double getFps() const override { return fps; }
+};
+
+// Writes packed BGR24 frames to a stream, e.g. the stdin of
+// `ffmpeg -f rawvideo -pix_fmt bgr24 -s WxH -i - out.mp4`.
+class RawPipeSink : public FrameSink {
+  std::FILE* stream;
+  bool ownsStream;
+
+ public:
+  // Does not take ownership of the stream (e.g. stdout).
+  explicit RawPipeSink(std::FILE* stream) : stream(stream), ownsStream(false) {}
+
+  // Opens a file or named pipe.
+  explicit RawPipeSink(const std::string& path)
+      : stream(std::fopen(path.c_str(), "wb")), ownsStream(true) {}
+
+  RawPipeSink(const RawPipeSink&) = delete;
+  RawPipeSink& operator=(const RawPipeSink&) = delete;
+
+  ~RawPipeSink() override {
+    if (ownsStream && stream != nullptr) {
+      std::fclose(stream);
+    } else if (stream != nullptr) {
+      std::fflush(stream);
+    }
+  }
+
+  bool isOpened() const override { return stream != nullptr; }
+
+  bool write(const cv::Mat& frame) override {
+    if (stream == nullptr || frame.type() != CV_8UC3) {
+      return false;
+    }
+    if (frame.isContinuous()) {
+      const size_t bytes = frame.total() * frame.elemSize();
+      return std::fwrite(frame.data, 1, bytes, stream) == bytes;
+    }
+    // ROI views are not continuous: write row by row instead of copying.
+    const size_t rowBytes = frame.cols * frame.elemSize();
+    for (int y = 0; y < frame.rows; ++y) {
+      if (std::fwrite(frame.ptr(y), 1, rowBytes, stream) != rowBytes) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <video_filter/FrameIO.hpp>
+#include <video_filter/detail/stringUtils.hpp>
+
+class VideoFileSource : public FrameSource {
+  cv::VideoCapture cap;
+
+ public:
+  explicit VideoFileSource(const std::string& inputFile) : cap(inputFile) {}
+
+  bool isOpened() const override { return cap.isOpened(); }
+
+  bool read(cv::Mat& frame) override { return cap.read(frame); }
+
+  cv::Size getFrameSize() const override {
+    return cv::Size(static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH)),
+                    static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT)));
+  }
+
+  double getFps() const override { return cap.get(cv::CAP_PROP_FPS); }
+
+  int getFrameCount() const override {
+    return static_cast<int>(cap.get(cv::CAP_PROP_FRAME_COUNT));
+  }
+};
+
+class VideoFileSink : public FrameSink {
+  cv::VideoWriter writer;
+
+ public:
+  VideoFileSink(const std::string& outputFile, double fps, const cv::Size& frameSize) {
+    const int codec = getCodec(outputFile);
+    if (codec == -1) {
+      std::cerr << "Unsupported output video format" << std::endl;
+      return;
+    }
+    writer.open(outputFile, codec, fps, frameSize);
+  }
+
+  bool isOpened() const override { return writer.isOpened(); }
+
+  bool write(const cv::Mat& frame) override {
+    writer.write(frame);
+    return true;
+  }
+
+  static int getCodec(const std::string& outputFile) {
+    std::string fileExtension = getExtension(outputFile);
+    if (fileExtension == "mp4" || fileExtension == "MP4") {
+      return cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+    } else if (fileExtension == "avi") {
+      return cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+    } else if (fileExtension == "mov" || fileExtension == "MOV") {
+      return cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+    } else {
+      return -1;
+    }
+  }
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size thread pool. Every worker owns a deque: it pops its own tasks
+// from the back and steals from the front of the other deques once its own
+// deque runs dry, so long jobs do not leave the remaining workers idle.
+class WorkStealingPool {
+ public:
+  explicit WorkStealingPool(size_t numWorkers) {
+    numWorkers = std::max<size_t>(1, numWorkers);
+    for (size_t i = 0; i < numWorkers; ++i) {
+      queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < numWorkers; ++i) {
+      workers.emplace_back([this, i] { workerLoop(i); });
+    }
+  }
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  ~WorkStealingPool() {
+    wait();
+    {
+      std::lock_guard<std::mutex> lock(stateMutex);
+      stop = true;
+    }
+    taskAvailable.notify_all();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  size_t size() const { return workers.size(); }
+
+  void submit(std::function<void()> task) {
+    const size_t target = nextQueue++ % queues.size();
+    {
+      // Count the task before publishing it, otherwise a worker could pop
+      // and finish it before the counters know about it.
+      std::lock_guard<std::mutex> lock(stateMutex);
+      ++queued;
+      ++unfinished;
+      std::lock_guard<std::mutex> queueLock(queues[target]->mutex);
+      queues[target]->tasks.push_back(std::move(task));
+    }
+    taskAvailable.notify_one();
+  }
+
+  // Blocks until every submitted task has finished.
+  void wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return unfinished == 0; });
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<size_t> nextQueue{0};
+
+  std::mutex stateMutex;
+  std::condition_variable taskAvailable;
+  std::condition_variable allDone;
+  size_t queued = 0;
+  size_t unfinished = 0;
+  bool stop = false;
+
+  bool popOwn(size_t index, std::function<void()>* task) {
+    Queue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      return false;
+    }
+    *task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+  }
+
+  bool steal(size_t thief, std::function<void()>* task) {
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+      Queue& victim = *queues[(thief + offset) % queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        *task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void workerLoop(size_t index) {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        taskAvailable.wait(lock, [this] { return stop || queued > 0; });
+        if (queued == 0) {
+          return;  // stop requested and nothing left to do
+        }
+      }
+
+      std::function<void()> task;
+      if (!popOwn(index, &task) && !steal(index, &task)) {
+        // Another worker took it between the wake up and the pop.
+        continue;
+      }
+      {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        --queued;
+      }
+
+      try {
+        task();
+      } catch (const std::exception& e) {
+        std::cerr << "Worker task failed: " << e.what() << std::endl;
+      } catch (...) {
+        std::cerr << "Worker task failed with unknown exception" << std::endl;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (--unfinished == 0) {
+          allDone.notify_all();
+        }
+      }
+    }
+  }
+};
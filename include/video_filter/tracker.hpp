@@ -131,6 +131,7 @@ class Tracker {
   }
 
   void updateReferenceFrame(const cv::Mat& frame) {
-    referenceFrame = frame(lastRoi);
+    // Copy: the frame buffer belongs to the caller and is reused or modified.
+    referenceFrame = frame(lastRoi).clone();
   }
 };